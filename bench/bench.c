@@ -0,0 +1,520 @@
+/**
+ * @file bench.c
+ * @author Korneev Nikita
+ * @brief Benchmark driver running searches over the synthetic corpus.
+ * @version 1.0
+ * @date 2025-05-30
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <ftw.h>
+#include <time.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <threads.h>
+
+#include "pool.h"
+#include "scan.h"
+#include "walk.h"
+#include "context.h"
+#include "matcher.h"
+
+/// Token planted by the corpus generator.
+#define BENCH_TOKEN "needle_xq"
+/// Patterns of the multi-pattern engine, only the first one occurs.
+#define BENCH_PATTERNS { BENCH_TOKEN, "haystack_zz", "timeout_qq", "request_qq" }
+/// Regular expression matching the token.
+#define BENCH_REGEX "needle_x[a-z]"
+/// Default measured runs of every configuration.
+#define BENCH_RUNS 3
+/// Corpus subdirectories, configurations and list items at most.
+#define BENCH_MAX_ITEMS 32
+
+/**
+ * @brief Search engine selectable by name.
+ *
+ */
+typedef struct
+{
+    const char *name;           /// Name on command line and in the report.
+    search_kind_t kind;         /// Forced substring algorithm, `SEARCH_ENGINE_AUTO` for the others.
+    int multi;                  /// Several patterns through Aho-Corasick.
+    int regex;                  /// Regular expression through the DFA.
+} bench_engine_t;
+
+/// Engines in report order.
+static const bench_engine_t engines[] = {
+    { "memchr", SEARCH_ENGINE_MEMCHR, 0, 0 },
+    { "horspool", SEARCH_ENGINE_HORSPOOL, 0, 0 },
+    { "twoway", SEARCH_ENGINE_TWOWAY, 0, 0 },
+    { "simd", SEARCH_ENGINE_SIMD, 0, 0 },
+    { "aho", SEARCH_ENGINE_AUTO, 1, 0 },
+    { "regex", SEARCH_ENGINE_AUTO, 0, 1 },
+};
+
+/// I/O backends in report order.
+static const struct
+{
+    const char *name;
+    scan_io_t io;
+} backends[] = {
+    { "auto", SCAN_IO_AUTO },
+    { "mmap", SCAN_IO_MMAP },
+    { "read", SCAN_IO_READ },
+    { "uring", SCAN_IO_URING },
+};
+
+/**
+ * @brief Per-file latencies measured by one worker.
+ *
+ */
+typedef struct
+{
+    double *items;              /// Seconds spent in every file task.
+    size_t count;               /// Amount of measured files.
+    size_t cap;                 /// Capacity of `items`.
+} bench_latency_t;
+
+/**
+ * @brief Output of a run, whose lines are counted by a reader thread.
+ *
+ */
+typedef struct
+{
+    int fd;                     /// Read end of the output pipe.
+    size_t lines;               /// Lines read, one per match.
+} bench_output_t;
+
+/// Totals of the corpus subdirectory being walked by `count_file`.
+static size_t corpus_files;
+static size_t corpus_bytes;
+
+/**
+ * @brief Seconds of the monotonic clock.
+ *
+ */
+static double bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Adds regular file to the corpus totals, used with `nftw`.
+ *
+ */
+static int count_file(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    (void)path;
+    (void)ftw;
+    if (type == FTW_F && S_ISREG(st->st_mode))
+    {
+        ++corpus_files;
+        corpus_bytes += (size_t)st->st_size;
+    }
+    return 0;
+}
+
+/**
+ * @brief File task measuring its own latency.
+ *
+ * @param worker    - worker executing the task.
+ * @param arg       - see `thrd_search_args_t`, released on return.
+ */
+static void timed_search(pool_worker_t *worker, void *arg)
+{
+    thrd_search_args_t *targ = arg;
+    bench_latency_t *latency = (bench_latency_t *)targ->ctx->visit_state + worker->id;
+
+    double start = bench_now();
+    thread_search(worker, arg);
+    double elapsed = bench_now() - start;
+
+    if (latency->count == latency->cap)
+    {
+        size_t grown = latency->cap ? latency->cap * 2 : 1024;
+        double *items = realloc(latency->items, grown * sizeof(double));
+        if (!items)
+            return;
+        latency->items = items;
+        latency->cap = grown;
+    }
+    latency->items[latency->count++] = elapsed;
+}
+
+/**
+ * @brief Counts lines written by the search, started as a thread.
+ *
+ */
+static int count_output(void *arg)
+{
+    bench_output_t *output = arg;
+    char buffer[1 << 16];
+    ssize_t count;
+    while ((count = read(output->fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (const char *p = buffer; (p = memchr(p, '\n', (size_t)(buffer + count - p))) != NULL; ++p)
+            ++output->lines;
+    }
+    return 0;
+}
+
+/**
+ * @brief Compiles patterns of the engine.
+ *
+ * @param matcher   - matcher to initialize.
+ * @param engine    - engine to benchmark.
+ * @return -1 on error and 0 on success.
+ */
+static int bench_matcher(matcher_t *matcher, const bench_engine_t *engine)
+{
+    static const char *const multi[] = BENCH_PATTERNS;
+    pattern_list_t patterns = { NULL, NULL, 0, 0 };
+    int status = 0;
+    if (engine->multi)
+    {
+        for (size_t i = 0; i < sizeof(multi) / sizeof(multi[0]) && status == 0; ++i)
+            status = pattern_list_add(&patterns, multi[i], strlen(multi[i]));
+    }
+    else if (engine->regex)
+        status = pattern_list_add(&patterns, BENCH_REGEX, strlen(BENCH_REGEX));
+    else
+        status = pattern_list_add(&patterns, BENCH_TOKEN, strlen(BENCH_TOKEN));
+
+    if (status == 0)
+        status = matcher_init(matcher, &patterns, engine->regex ? MATCHER_REGEX : 0, stderr);
+
+    // Substring algorithm chosen by pattern length is replaced with the benchmarked one
+    if (status == 0 && engine->kind != SEARCH_ENGINE_AUTO)
+    {
+        search_engine_destroy(&matcher->engine);
+        status = search_engine_init(&matcher->engine, BENCH_TOKEN, strlen(BENCH_TOKEN), engine->kind, 0);
+    }
+    pattern_list_destroy(&patterns);
+    return status;
+}
+
+/**
+ * @brief Searches directory once.
+ *
+ * @param matcher   - compiled patterns.
+ * @param pool      - started pool.
+ * @param io        - I/O backend.
+ * @param dirpath   - directory to search.
+ * @param latency   - latencies of every worker, NULL if they are not measured.
+ * @param matches   - amount of reported matches.
+ * @return -1 on error and elapsed seconds on success.
+ */
+static double bench_run(const matcher_t *matcher, pool_t *pool, scan_io_t io, const char *dirpath,
+    bench_latency_t *latency, size_t *matches)
+{
+    int pipe_fd[2];
+    if (pipe(pipe_fd) < 0)
+        return -1;
+
+    bench_output_t output = { pipe_fd[0], 0 };
+    thrd_t reader;
+    if (thrd_create(&reader, count_output, &output) != thrd_success)
+    {
+        close(pipe_fd[0]);
+        close(pipe_fd[1]);
+        return -1;
+    }
+
+    search_context_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.matcher = matcher;
+    ctx.depth = 1 << 10;
+    ctx.out_fd = pipe_fd[1];
+    ctx.cwd_fd = AT_FDCWD;
+    ctx.err = stderr;
+    ctx.io = io;
+    ctx.report = SCAN_REPORT_OFFSETS;
+
+    // Files grouped for io_uring are not separate tasks, so their latency is not measured
+    ctx.visit = latency ? &timed_search : NULL;
+    ctx.visit_state = latency;
+
+    double elapsed = -1;
+    if (search_context_init(&ctx, pool) == 0)
+    {
+        double start = bench_now();
+        if (search_directory(&ctx, dirpath) == 0)
+        {
+            pool_wait(pool);
+            search_context_flush(&ctx);
+            elapsed = bench_now() - start;
+        }
+        search_context_destroy(&ctx);
+    }
+
+    close(pipe_fd[1]);
+    thrd_join(reader, NULL);
+    close(pipe_fd[0]);
+    *matches = output.lines;
+    return elapsed;
+}
+
+/**
+ * @brief Compares latencies for `qsort`.
+ *
+ */
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Runs one configuration and prints its report line.
+ *
+ * @param name      - corpus subdirectory name.
+ * @param dirpath   - corpus subdirectory path.
+ * @param engine    - engine to benchmark.
+ * @param backend   - index in `backends`.
+ * @param threads   - amount of workers.
+ * @param runs      - measured runs, the median one is reported.
+ * @return -1 on error and 0 on success.
+ */
+static int bench_config(const char *name, const char *dirpath, const bench_engine_t *engine, size_t backend,
+    size_t threads, size_t runs)
+{
+    matcher_t matcher;
+    if (bench_matcher(&matcher, engine) < 0)
+    {
+        fprintf(stderr, "%s: failed to compile patterns\n", engine->name);
+        return -1;
+    }
+
+    pool_t pool;
+    if (pool_init(&pool, threads, NULL) < 0)
+    {
+        fprintf(stderr, "Failed to start worker threads\n");
+        matcher_destroy(&matcher);
+        return -1;
+    }
+
+    scan_io_t io = backends[backend].io;
+    bench_latency_t *latency = io == SCAN_IO_URING ? NULL : calloc(pool.workers, sizeof(bench_latency_t));
+    double times[BENCH_MAX_ITEMS];
+    size_t matches = 0;
+    int status = 0;
+
+    // First run warms page cache and allocator, it is not measured
+    for (size_t run = 0; run <= runs && status == 0; ++run)
+    {
+        if (latency && run == 1)
+            for (size_t i = 0; i < pool.workers; ++i)
+                latency[i].count = 0;
+
+        double elapsed = bench_run(&matcher, &pool, io, dirpath, latency, &matches);
+        if (elapsed < 0)
+            status = -1;
+        else if (run > 0)
+            times[run - 1] = elapsed;
+    }
+
+    if (status == 0)
+    {
+        qsort(times, runs, sizeof(double), compare_double);
+        double median = times[runs / 2];
+
+        // Latencies of all measured runs are merged
+        size_t total = 0;
+        for (size_t i = 0; latency && i < pool.workers; ++i)
+            total += latency[i].count;
+        double *all = total ? malloc(total * sizeof(double)) : NULL;
+        char p50[32] = "-";
+        char p99[32] = "-";
+        if (all)
+        {
+            size_t pos = 0;
+            for (size_t i = 0; i < pool.workers; ++i)
+            {
+                if (latency[i].count)
+                    memcpy(all + pos, latency[i].items, latency[i].count * sizeof(double));
+                pos += latency[i].count;
+            }
+            qsort(all, total, sizeof(double), compare_double);
+            snprintf(p50, sizeof(p50), "%.1f", all[total / 2] * 1e6);
+            snprintf(p99, sizeof(p99), "%.1f", all[total * 99 / 100] * 1e6);
+            free(all);
+        }
+
+        printf("%-8s %-9s %-6s %7zu %12.0f %8.3f %12.0f %10s %10s\n", name, engine->name, backends[backend].name,
+            pool.workers, (double)corpus_files / median, (double)corpus_bytes / median * 1e-9,
+            (double)matches / median, p50, p99);
+        fflush(stdout);
+    }
+
+    for (size_t i = 0; latency && i < pool.workers; ++i)
+        free(latency[i].items);
+    free(latency);
+    pool_destroy(&pool);
+    matcher_destroy(&matcher);
+    return status;
+}
+
+/**
+ * @brief Splits comma separated list in place.
+ *
+ * @param list  - list to split.
+ * @param items - pointers to items.
+ * @return Amount of items.
+ */
+static size_t split_list(char *list, char **items)
+{
+    size_t count = 0;
+    for (char *item = strtok(list, ","); item && count < BENCH_MAX_ITEMS; item = strtok(NULL, ","))
+        items[count++] = item;
+    return count;
+}
+
+/**
+ * @brief Compares names for `qsort`.
+ *
+ */
+static int compare_name(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+int main(int argc, char **argv)
+{
+    const char *usage = "Usage: %s <corpus> [-c <dirs>] [-e <engines>] [-o <io>] [-j <threads>] [-n <runs>]\n";
+    if (argc < 2)
+    {
+        fprintf(stderr, usage, argv[0]);
+        return -1;
+    }
+
+    // Defaults run every engine and backend with one worker and one per CPU
+    char cpus[32];
+    if (pool_cpu_count() > 1)
+        snprintf(cpus, sizeof(cpus), "1,%zu", pool_cpu_count());
+    else
+        snprintf(cpus, sizeof(cpus), "1");
+    char default_engines[] = "memchr,horspool,twoway,simd,aho,regex";
+    char default_io[] = "auto,mmap,read,uring";
+    char *dirs_arg = NULL;
+    char *engines_arg = default_engines;
+    char *io_arg = default_io;
+    char *threads_arg = cpus;
+    size_t runs = BENCH_RUNS;
+
+    int option;
+    optind = 2;
+    while ((option = getopt(argc, argv, "c:e:o:j:n:")) != -1)
+    {
+        switch (option)
+        {
+        case 'c':
+            dirs_arg = optarg;
+            break;
+        case 'e':
+            engines_arg = optarg;
+            break;
+        case 'o':
+            io_arg = optarg;
+            break;
+        case 'j':
+            threads_arg = optarg;
+            break;
+        case 'n':
+            runs = atoi(optarg) > 0 ? (size_t)atoi(optarg) : BENCH_RUNS;
+            runs = runs < BENCH_MAX_ITEMS ? runs : BENCH_MAX_ITEMS;
+            break;
+        default:
+            fprintf(stderr, usage, argv[0]);
+            return -1;
+        }
+    }
+
+    // Every subdirectory of the corpus is benchmarked separately
+    char *dirs[BENCH_MAX_ITEMS];
+    size_t dir_count = 0;
+    if (dirs_arg)
+        dir_count = split_list(dirs_arg, dirs);
+    else
+    {
+        DIR *root = opendir(argv[1]);
+        if (!root)
+        {
+            perror(argv[1]);
+            return -1;
+        }
+        struct dirent *entry;
+        while ((entry = readdir(root)) != NULL && dir_count < BENCH_MAX_ITEMS)
+            if (entry->d_type == DT_DIR && entry->d_name[0] != '.')
+                dirs[dir_count++] = strdup(entry->d_name);
+        closedir(root);
+        qsort(dirs, dir_count, sizeof(char *), compare_name);
+    }
+
+    char *engine_names[BENCH_MAX_ITEMS];
+    char *io_names[BENCH_MAX_ITEMS];
+    char *thread_counts[BENCH_MAX_ITEMS];
+    size_t engine_count = split_list(engines_arg, engine_names);
+    size_t io_count = split_list(io_arg, io_names);
+    size_t thread_count = split_list(threads_arg, thread_counts);
+
+    walk_raise_fd_limit();
+    printf("%-8s %-9s %-6s %7s %12s %8s %12s %10s %10s\n", "corpus", "engine", "io", "threads", "files/s", "GB/s",
+        "matches/s", "p50_us", "p99_us");
+
+    int status = 0;
+    for (size_t d = 0; d < dir_count; ++d)
+    {
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", argv[1], dirs[d]);
+        corpus_files = 0;
+        corpus_bytes = 0;
+        if (nftw(path, count_file, 64, FTW_PHYS) < 0)
+        {
+            perror(path);
+            status = -1;
+            continue;
+        }
+
+        for (size_t e = 0; e < engine_count; ++e)
+        {
+            const bench_engine_t *engine = NULL;
+            for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); ++i)
+                if (strcmp(engines[i].name, engine_names[e]) == 0)
+                    engine = &engines[i];
+
+            for (size_t o = 0; o < io_count; ++o)
+            {
+                size_t backend = sizeof(backends) / sizeof(backends[0]);
+                for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); ++i)
+                    if (strcmp(backends[i].name, io_names[o]) == 0)
+                        backend = i;
+
+                if (!engine || backend == sizeof(backends) / sizeof(backends[0]))
+                {
+                    fprintf(stderr, "Unknown engine %s or backend %s\n", engine_names[e], io_names[o]);
+                    return -1;
+                }
+
+                for (size_t t = 0; t < thread_count; ++t)
+                    if (bench_config(dirs[d], path, engine, backend, (size_t)atoi(thread_counts[t]), runs) < 0)
+                        status = -1;
+            }
+        }
+    }
+
+    if (!dirs_arg)
+        for (size_t d = 0; d < dir_count; ++d)
+            free(dirs[d]);
+    return status;
+}
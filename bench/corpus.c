@@ -0,0 +1,231 @@
+/**
+ * @file corpus.c
+ * @author Korneev Nikita
+ * @brief Reproducible synthetic corpus for benchmarks.
+ * @version 1.0
+ * @date 2025-05-30
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/// Token planted into files, searched by the benchmark.
+#define CORPUS_TOKEN "needle_xq"
+/// Words text files are made of.
+#define CORPUS_WORDS { "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "error", "warning", \
+    "request", "server", "needle", "haystack", "timeout", "thread", "worker", "queue", "index", "value" }
+/// Longest line of generated text.
+#define CORPUS_LINE 120
+
+/**
+ * @brief Shape of one corpus subdirectory.
+ *
+ */
+typedef struct
+{
+    const char *name;       /// Subdirectory name.
+    size_t files;           /// Amount of files at scale 1.
+    size_t min_size;        /// Smallest file.
+    size_t max_size;        /// Biggest file.
+    size_t density;         /// Average bytes between tokens, 0 for none.
+    size_t fanout;          /// Files per directory, 0 for one flat directory.
+    size_t depth;           /// Nesting of directories, every level holds `fanout` files.
+    int binary;             /// Files are random bytes instead of text.
+} corpus_profile_t;
+
+/// Profiles written by the generator.
+static const corpus_profile_t profiles[] = {
+    { "tiny", 20000, 64, 2048, 50000, 200, 1, 0 },
+    { "huge", 2, 64 << 20, 96 << 20, 1 << 20, 0, 1, 0 },
+    { "deep", 640, 2048, 16384, 20000, 10, 64, 0 },
+    { "dense", 100, 256 << 10, 768 << 10, 64, 0, 1, 0 },
+    { "sparse", 100, 256 << 10, 768 << 10, 1 << 20, 0, 1, 0 },
+    { "binary", 500, 16 << 10, 128 << 10, 200000, 0, 1, 1 },
+};
+
+/**
+ * @brief xorshift64* generator, the only source of randomness.
+ *
+ * @param state - generator state, never zero.
+ * @return Next random number.
+ */
+static uint64_t next_random(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Random number in [low, high].
+ *
+ */
+static size_t random_range(uint64_t *state, size_t low, size_t high)
+{
+    return high > low ? low + (size_t)(next_random(state) % (high - low + 1)) : low;
+}
+
+/**
+ * @brief Writes one file of the profile.
+ *
+ * @param path      - path of the file.
+ * @param profile   - shape of the file.
+ * @param state     - generator state.
+ * @return -1 on error and 0 on success.
+ */
+static int write_file(const char *path, const corpus_profile_t *profile, uint64_t *state)
+{
+    static const char *const words[] = CORPUS_WORDS;
+    const size_t word_count = sizeof(words) / sizeof(words[0]);
+
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        perror(path);
+        return -1;
+    }
+
+    size_t size = random_range(state, profile->min_size, profile->max_size);
+    size_t token_len = strlen(CORPUS_TOKEN);
+    char line[CORPUS_LINE + 32];
+    for (size_t written = 0; written < size;)
+    {
+        size_t len = 0;
+        if (profile->binary)
+        {
+            // Noise has NUL bytes and no line structure
+            for (; len < CORPUS_LINE; len += 8)
+            {
+                uint64_t bits = next_random(state);
+                memcpy(line + len, &bits, 8);
+            }
+        }
+        else
+        {
+            while (len < CORPUS_LINE - 16)
+            {
+                const char *word = words[next_random(state) % word_count];
+                size_t word_len = strlen(word);
+                memcpy(line + len, word, word_len);
+                len += word_len;
+                line[len++] = ' ';
+            }
+            line[len - 1] = '\n';
+        }
+
+        // Token lands in a chunk with probability matching the density
+        if (profile->density && next_random(state) % profile->density < len)
+        {
+            size_t at = random_range(state, 0, len - token_len - 1);
+            memcpy(line + at, CORPUS_TOKEN, token_len);
+        }
+
+        if (len > size - written)
+            len = size - written;
+        if (fwrite(line, 1, len, file) != len)
+        {
+            perror(path);
+            fclose(file);
+            return -1;
+        }
+        written += len;
+    }
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Creates directory, existing ones are reused.
+ *
+ */
+static int make_dir(const char *path)
+{
+    if (mkdir(path, 0755) < 0 && errno != EEXIST)
+    {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Writes every file of the profile under its subdirectory.
+ *
+ * @param root      - corpus directory.
+ * @param profile   - profile to write.
+ * @param scale     - multiplier of the amount of files.
+ * @param seed      - seed of the whole corpus.
+ * @return -1 on error and 0 on success.
+ */
+static int write_profile(const char *root, const corpus_profile_t *profile, size_t scale, uint64_t seed)
+{
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s/%s", root, profile->name);
+    if (make_dir(dir) < 0)
+        return -1;
+
+    // Every profile has its own stream, so profiles do not depend on each other
+    uint64_t state = seed;
+    for (const char *c = profile->name; *c; ++c)
+        state = (state ^ (unsigned char)*c) * 0x100000001B3ULL;
+    state |= 1;
+
+    size_t files = profile->files * scale;
+    size_t dir_len = strlen(dir);
+    for (size_t i = 0; i < files; ++i)
+    {
+        // Deep profile nests every `fanout` files one level further, flat ones spread them over directories
+        if (profile->fanout && i % profile->fanout == 0)
+        {
+            if (profile->depth > 1)
+            {
+                size_t level = (i / profile->fanout) % profile->depth;
+                if (level == 0)
+                    dir_len = (size_t)snprintf(dir, sizeof(dir), "%s/%s/t%zu", root, profile->name, i / (profile->fanout * profile->depth));
+                else
+                    dir_len += (size_t)snprintf(dir + dir_len, sizeof(dir) - dir_len, "/l%zu", level);
+            }
+            else
+                dir_len = (size_t)snprintf(dir, sizeof(dir), "%s/%s/d%zu", root, profile->name, i / profile->fanout);
+            if (dir_len >= sizeof(dir) - 32 || make_dir(dir) < 0)
+                return -1;
+        }
+
+        char path[4096 + 32];
+        snprintf(path, sizeof(path), "%s/f%zu.%s", dir, i, profile->binary ? "bin" : "txt");
+        if (write_file(path, profile, &state) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <directory> [scale] [seed]\n", argv[0]);
+        return -1;
+    }
+
+    size_t scale = argc > 2 && atoi(argv[2]) > 0 ? (size_t)atoi(argv[2]) : 1;
+    uint64_t seed = argc > 3 ? strtoull(argv[3], NULL, 0) : 0x5eed;
+    if (make_dir(argv[1]) < 0)
+        return -1;
+
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); ++i)
+    {
+        printf("%s/%s\n", argv[1], profiles[i].name);
+        if (write_profile(argv[1], &profiles[i], scale, seed) < 0)
+            return -1;
+    }
+    return 0;
+}